@@ -26,6 +26,9 @@
  *
  * Set tabs to 3 to get a readable source.
 \*************************************************************************/
+#ifdef __linux__
+#define _GNU_SOURCE		/* ppoll() for follow mode */
+#endif
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
@@ -33,6 +36,19 @@
 #include <malloc.h>
 #include <getopt.h>
 
+#if defined __linux__ && !defined FUZZ  /* follow mode needs inotify */
+#define FOLLOW
+#endif
+#ifdef FOLLOW
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#endif
+
 #ifndef __GNUC__
 #define __inline__
 #define __atribute__( dummy )
@@ -55,14 +71,25 @@ void wrong_parameter() __attribute__(( noreturn ));
 void help() __attribute__(( noreturn ));
 void spc( uchar* string, __const__ size_t n );
 void printpg();
+void printpgpart();
 void printpgrest();
 void puttooutbuf( uchar *string );
 void setnewline();
+void allocpg();
+#ifdef FOLLOW
+void flushpg();
+void followfile( FILE *in_file );
+#endif
+#ifdef FUZZ
+void puttooutbuf_ref( uchar *string );
+void setnewline_ref();
+#endif
 
 /*************************************************************************\
  * Global variables used in this program 
 \*************************************************************************/
 #define DEFAULT_MARGIN 4
+#define DEFAULT_IDLE 500
 static uchar *prog = NULL;				/* Name of this program found in argv[0] */
 /* Variables which represent the command line options initialised with
  * default values */
@@ -72,7 +99,9 @@ static int col_width = 72;          /* characters per column:
                                      * maximal length of displayed text in one
                                      * column */
 static int cols = 1;                /* number of text columns */
+#ifndef FUZZ  /* the fuzzing harness reads no files */
 static int sepfiles = 0;            /* flag: start new files on new page? */
+#endif
 static int word_wrap = 0;				/* flag: word wrap? */
 static int sendff = 0;              /* flag: send chr(12) afer each page? */
 static int expand_tabs = 0;			/* flag: expand tabs to spaces? */
@@ -81,6 +110,13 @@ static int tab_spc = 4;					/* number of spaces to insert for one tab */
 static int left_spc = 0;				/* number of blanks at the beginning of */
                                     /* each line */
 static int mid_spc = 1;					/* number of blanks between columns */
+#ifdef FOLLOW
+static int follow = 0;					/* flag: wait for the input to grow? */
+static int idle_ms = DEFAULT_IDLE;	/* maximal milliseconds between new input
+												 * and its output in follow mode */
+static volatile sig_atomic_t stop_follow = 0;	/* flag: SIGINT or SIGTERM
+												 * received in follow mode */
+#endif
 
 /* Global variables which are used during file processing */                                    
 static FILE *out_file = NULL;
@@ -92,7 +128,18 @@ static uchar *pcur_pos;					/* character arrays */
 static uchar **cur_page; 				/* pointer to the page to be printed 
 												 * next */
 
+#ifdef FOLLOW
+#define USAGE "%s [-BdfhW -cn -Fn -ln -mn -ofile -tn -wn -Wn files]\n"
+#define FOLLOW_HELP "\t-F: follow the last file (until ^C), print finished lines after\n" \
+                    "\t    at most n ms (%d)\n"
+#define FOLLOW_ARG , idle_ms
+#define OPTIONS "c:dfF::hl:m::o:t::w:W:sB"
+#else
 #define USAGE "%s [-BdfhW -cn -ln -mn -ofile -tn -wn -Wn files]\n"
+#define FOLLOW_HELP
+#define FOLLOW_ARG
+#define OPTIONS "c:dfhl:m::o:t::w:W:sB"
+#endif
 
 /*************************************************************************\
  * Fill a string with n blanks and append a NULL character 
@@ -124,9 +171,11 @@ void help()
 		"\t-W: width of output page (%d)\n" 
 		"\t-s: seperate files - each file will begin on a new page\n" 
 		"\t-B: break lines between words only (word wrap)\n" 
+		FOLLOW_HELP
 		"\nIf no file is specified stdin is used for input and stdout for output.\n" 
 		"Values in brackets are the defaults\n", 
 		prog, cols, pg_lines, DEFAULT_MARGIN, tab_spc, col_width, pg_width
+		FOLLOW_ARG
 	); /* end fprintf */
 	exit(0);
 }
@@ -230,6 +279,18 @@ void puttooutbuf( uchar *string )
 					break;
 				}
 			default:
+				/* copy a run of ordinary characters at once, as long as it
+				 * stops in front of the last position of the column */
+				n = col_width + word_wrap - cur_col_pos - 1;
+				if ( n > 0 ) {
+					l = strcspn( (char*)pstrc, expand_tabs ? "\n\t" : "\n" );
+					if ( l > (size_t)n ) l = (size_t)n;
+					memcpy( pcur_pos, pstrc, l );
+					pcur_pos+= l;
+					cur_col_pos+= l;
+					pstrc+= l - 1;
+					break;
+				}
 				/* copy character from parameter string to output page
 				 * and increment the output position */
 				*pcur_pos++ = *pstrc;
@@ -281,6 +342,132 @@ void puttooutbuf( uchar *string )
 	return;
 }
 
+#ifdef FUZZ
+/*************************************************************************\
+ * Reference engine used by the fuzzing harness.
+ * puttooutbuf_ref() and setnewline_ref() are the original character by
+ * character implementation of puttooutbuf() and setnewline(). They must
+ * not be optimized: every faster version of the layout code is checked
+ * against them byte by byte (see LLVMFuzzerTestOneInput()).
+\*************************************************************************/
+void setnewline_ref()
+{
+	int abs_pos;			/* Absolute position in the new line of cur_page */
+	int len;					/* Absolute length or the new line */
+	int spc_to_ins;		/* Number of blanks to insert in the new line */
+
+	if ( cur_line >= pg_lines ) { 	/* End of column reached? */
+		cur_col++;								/* Begin a new column and */
+		cur_line = 0;							/* start at line 0 */
+		if ( cur_col >= cols ) {			/* End of page reached? */
+			printpg();								/* Print page and */
+			cur_col = 0;							/* restart at column 0 */
+		} /* end if */
+	} /* end if */
+	/* fill the space between the end of the last column and */
+	/* the begining of the current column with blanks */
+	len = strlen( cur_page[cur_line] );
+	abs_pos = left_spc + cur_col * (col_width + mid_spc);
+	spc_to_ins = abs_pos - len;
+	spc( &cur_page[cur_line][len], spc_to_ins );
+	cur_col_pos = 0;
+	pcur_pos = &cur_page[cur_line][abs_pos];
+	return;
+}
+
+void puttooutbuf_ref( uchar *string )
+{
+   int n;
+   size_t l;
+   uchar *pstrc;			/* points to the next character in param "string"  */
+   uchar *pc;				/* temporary pointer used during word wraping */
+   uchar *pcol_start;	/* " */
+   uchar *pwrap_str;		/* " */
+   uchar c;					/* temporary character variable used during word
+								 * wraping */
+	uchar *tabstr;			/* inserted string for tabs if the flag "expand_tabs"
+								 * is set */
+	for ( pstrc = string; *pstrc != '\0'; pstrc++ ) {
+		/* Examine every character in string before putting it to the */
+		/* output buffer. */
+		switch( *pstrc ) {
+			case '\n':
+				/* mark the end of the line */
+				*pcur_pos = '\0';
+				/* increment cur_line */
+				cur_line+= dbllf + 1;
+				setnewline_ref();
+				break;
+			case '\t':
+				if ( expand_tabs ) {
+					n = tab_spc - cur_col_pos % tab_spc;
+					if ( cur_col_pos + n >= col_width ) {
+						*pcur_pos = '\0';
+						cur_line++;
+						setnewline_ref();
+					} else {
+						if ( (tabstr = alloca(n + 1)) == NULL ) {
+							perror( "alloca" );
+							exit( 1 );
+						}
+						spc( tabstr, n );
+						puttooutbuf_ref( tabstr );
+					}
+					break;
+				}
+			default:
+				/* copy character from parameter string to output page
+				 * and increment the output position */
+				*pcur_pos++ = *pstrc;
+				cur_col_pos++;
+				/* test, if the end of a column is reached
+				 * if word wrapping is on, one more character can temporarly
+				 * be written in a line because the line will be broken
+				 * in front of this position */
+				if ( cur_col_pos >= col_width + word_wrap ) {
+					if ( word_wrap ) {
+						/* calculate the beginning of the current column */
+						pcol_start = &cur_page[cur_line][left_spc + cur_col * ( col_width + mid_spc )];
+						/* Find the last space character in the string */
+						for ( pc = pcur_pos - 1; !isspace(*pc) && pc > pcol_start; pc-- );
+						if ( pc > pcol_start ) {
+							/* A blank was found and pc points to its position */
+							/* delete the blank and set pc to the next character */
+							/* following */
+							*pc++ = '\0';
+							/* calculate the length of the string which has to be */
+							/* wraped */
+							l = (size_t)( pcur_pos - pc );
+							/* save the rest of the line */
+							pwrap_str = alloca( l );
+							strncpy( pwrap_str, pc, l );
+							cur_line++;
+							setnewline_ref();
+							/* copy the reset to the next line */
+							strncpy( pcur_pos, pwrap_str, l);
+							pcur_pos+= l;
+							cur_col_pos = l;
+						} else {
+							/* No blank was found in the current line: */
+							c = *(--pcur_pos);
+							*pcur_pos = '\0';
+							cur_line++;
+							setnewline_ref();
+							*pcur_pos++ = c;
+							cur_col_pos = 1;
+						} /* end if */
+					} else { /* no word wraping: */
+						*pcur_pos = '\0';
+						cur_line++;
+						setnewline_ref();
+					} /* end if word_wrap */
+				} /* end if ( cur_col_pos >= col_width ) */
+		} /* end switch */
+	} /* end for */
+	return;
+}
+#endif /* FUZZ */
+
 /*************************************************************************\
  * Function to print a page if it is full. After printing each line is
  * cleared and the global variables cur_col and cur_line are reset to zero
@@ -301,35 +488,258 @@ void printpg()
 }
 
 /*************************************************************************\
- * Function to print the rest of a page at the end of the program.
- * This function also frees all memmory allocated by cur_page.
+ * Function to print the used lines of a page which is not full.
  * Global variables changed:
- * 	cur_page	: Printed and freed.
+ * 	cur_page	: The current line is terminated.
 \************************************************************************/
-void printpgrest()
+void printpgpart()
 {
 	register int j;
 	int n;
 
+	/* terminate the current line, the last input line may not end with
+	 * a new line character */
+	*pcur_pos = '\0';
 	n = cur_col > 0 ? pg_lines : cur_line;
 	
 	for ( j = 0; j < n; j++ ) {
 		fputs( cur_page[j], out_file );		/* print line j of cur_page */
 		fputc( '\n', out_file );
-		free( cur_page[j] );
 	} /* end for */
-	for ( ; j < pg_lines; j++ )
+	if ( sendff ) fputc( '\f', out_file );
+	return;
+}
+
+/*************************************************************************\
+ * Function to print the rest of a page at the end of the program.
+ * This function also frees all memmory allocated by cur_page.
+ * Global variables changed:
+ * 	cur_page	: Printed and freed.
+\************************************************************************/
+void printpgrest()
+{
+	register int j;
+
+	printpgpart();
+	for ( j = 0; j < pg_lines; j++ )
 		free( cur_page[j] );
 	free( cur_page );
-	if ( sendff ) fputc( '\f', out_file );
 	return;
 }
 	
 
+#ifdef FOLLOW
+/*************************************************************************\
+ * Print the finished lines of the current page in follow mode and start
+ * a new page. The unfinished current line is not printed but moved to the
+ * first line of the new page, so that it can be continued.
+ * Global variables changed:
+ * 	cur_page	: Printed and cleared, except the current line.
+ * 	cur_col, cur_line	: = 0
+ * 	pcur_pos	: Set behind the moved text in line 0.
+\************************************************************************/
+void flushpg()
+{
+	register int j;
+	uchar *pline;			/* saved text of the current line */
+
+	if ( cur_col == 0 && cur_line == 0 ) return;	/* nothing finished yet */
+	/* cut the current line at the beginning of its column */
+	pcur_pos-= cur_col_pos;
+	if ( (pline = alloca( cur_col_pos + 1 )) == NULL ) {
+		perror( "alloca" );
+		exit( 1 );
+	}
+	memcpy( pline, pcur_pos, cur_col_pos );
+	printpgpart();
+	fflush( out_file );
+	for ( j = 0; j < pg_lines; j++ )
+		spc( cur_page[j], left_spc );			/* fill left margin */
+	cur_col = cur_line = 0;
+	pcur_pos = &cur_page[0][left_spc];
+	memcpy( pcur_pos, pline, cur_col_pos );
+	pcur_pos+= cur_col_pos;
+	return;
+}
+
+/*************************************************************************\
+ * Return a monotonic time in milliseconds.
+\************************************************************************/
+static long now_ms()
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/*************************************************************************\
+ * Signal handler for SIGINT and SIGTERM in follow mode: let followfile()
+ * return, so that the rest of the page is printed.
+\************************************************************************/
+static void stopfollow( int sig )
+{
+	stop_follow = 1;
+}
+
+/*************************************************************************\
+ * Read in_file in follow mode (-F). New input is put to the output buffer
+ * as soon as it arrives. A pipe or terminal is read with ppoll() until the
+ * writer closes it, a regular file is watched with inotify until SIGINT
+ * or SIGTERM is received (like tail -f).
+ * At the latest idle_ms milliseconds after the first input which was not
+ * printed yet the finished lines are flushed by flushpg(), even if more
+ * input keeps arriving; without pending output ppoll() waits without a
+ * timeout. An unfinished line (no new line character yet) is not printed
+ * before it is finished or the input ends.
+\************************************************************************/
+void followfile( FILE *in_file )
+{
+	uchar in_buf[129];		 				/* buffer to read the file */
+	char ev_buf[4096];						/* buffer for inotify events */
+	char path[32];								/* name of in_file in /proc */
+	struct pollfd pfd;
+	struct stat st;
+	ssize_t n;
+	int fd;
+	int ifd = -1;								/* inotify handle for regular files */
+	int pending = 1;							/* flag: something to flush? */
+	int got;										/* flag: new input read? */
+	long deadline;								/* time to flush the pending input */
+	long timeout;								/* milliseconds left until deadline */
+	struct sigaction sa;
+	sigset_t sigs, oldsigs;				/* SIGINT and SIGTERM are only
+												 * delivered while in ppoll() */
+	struct timespec ts;
+
+	/* no SA_RESTART: ppoll() returns with EINTR */
+	memset( &sa, 0, sizeof( sa ) );
+	sa.sa_handler = stopfollow;
+	sigemptyset( &sa.sa_mask );
+	sigaction( SIGINT, &sa, NULL );
+	sigaction( SIGTERM, &sa, NULL );
+	sigemptyset( &sigs );
+	sigaddset( &sigs, SIGINT );
+	sigaddset( &sigs, SIGTERM );
+	sigprocmask( SIG_BLOCK, &sigs, &oldsigs );
+	fd = fileno( in_file );
+	if ( fstat( fd, &st ) ) {
+		perror( "fstat" );
+		exit( 1 );
+	}
+	if ( S_ISREG( st.st_mode ) ) {
+		sprintf( path, "/proc/self/fd/%d", fd );
+		if ( (ifd = inotify_init1( IN_NONBLOCK )) < 0
+				|| inotify_add_watch( ifd, path, IN_MODIFY ) < 0 ) {
+			perror( "inotify" );
+			exit( 1 );
+		}
+		pfd.fd = ifd;
+		pfd.revents = POLLIN;				/* read what is already there */
+	} else {
+		pfd.fd = fd;
+		pfd.revents = 0;						/* read() would block */
+	}
+	pfd.events = POLLIN;
+	/* earlier files may have left a partial page */
+	deadline = now_ms() + idle_ms;
+	while ( !stop_follow ) {
+		if ( pfd.revents ) {
+			got = 0;
+			if ( ifd >= 0 ) {
+				while ( read( ifd, ev_buf, sizeof( ev_buf ) ) > 0 );
+				/* start again at the beginning if the file was truncated */
+				if ( fstat( fd, &st ) == 0 && st.st_size < lseek( fd, 0, SEEK_CUR ) )
+					lseek( fd, 0, SEEK_SET );
+				while ( (n = read( fd, in_buf, sizeof( in_buf ) - 1 )) > 0 ) {
+					in_buf[n] = '\0';
+					puttooutbuf( in_buf );
+					got = 1;
+				} /* end while */
+			} else {
+				if ( (n = read( fd, in_buf, sizeof( in_buf ) - 1 )) == 0 )
+					break;							/* writer closed the pipe */
+				if ( n > 0 ) {
+					in_buf[n] = '\0';
+					puttooutbuf( in_buf );
+					got = 1;
+				}
+			}
+			if ( n < 0 && errno != EINTR && errno != EAGAIN ) {
+				perror( "read" );
+				exit( 1 );
+			}
+			fflush( out_file );
+			/* the deadline starts with the first unprinted input and is
+			 * not moved by later input */
+			if ( got && !pending ) {
+				pending = 1;
+				deadline = now_ms() + idle_ms;
+			}
+		}
+		timeout = -1;
+		if ( pending && (timeout = deadline - now_ms()) <= 0 ) {
+			flushpg();
+			pending = 0;
+			timeout = -1;
+		}
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = timeout % 1000 * 1000000L;
+		if ( ppoll( &pfd, 1, timeout < 0 ? NULL : &ts, &oldsigs ) < 0 ) {
+			if ( errno == EINTR ) {
+				pfd.revents = 0;
+				continue;
+			}
+			perror( "ppoll" );
+			exit( 1 );
+		}
+	} /* end while */
+	sigprocmask( SIG_SETMASK, &oldsigs, NULL );
+	if ( ifd >= 0 ) close( ifd );
+	/* the input ends here: finish the last line, printpgrest() would not
+	 * print an unfinished line in the first column */
+	if ( cur_col_pos > 0 ) {
+		*pcur_pos = '\0';
+		cur_line++;
+		setnewline();
+	}
+	return;
+}
+#endif /* FOLLOW */
+
+/*************************************************************************\
+ * Allocate the output page and set the write position to its first line.
+ * Global variables changed:
+ * 	cur_page	: Allocated, every line filled with the left margin.
+ * 	pcur_pos	: Set to the start of line 0.
+\************************************************************************/
+void allocpg()
+{
+	register int j;
+
+	if ( !(cur_page = (uchar**)malloc( pg_lines * sizeof( uchar* ) )) ) {
+		perror( "malloc" );
+		exit(1);
+	} /* end if */
+	for ( j = 0; j < pg_lines; j++ ) {
+		/* allocate memory for every line. We need one extra byte if word
+		 * wrapping is on, because of a posible overlapping last character,
+		 * and one for the terminating NULL of a full line */
+		if ( !(cur_page[j] = (uchar*)malloc( (pg_width + word_wrap + 1) * sizeof(uchar)))) {
+			perror( "malloc" );
+			exit(1);
+		} /* end if */
+		spc( cur_page[j], left_spc );
+	} /* end for */
+	pcur_pos = &cur_page[0][left_spc];
+	return;
+}
+
 /************************************************************************\
  - - - - - - - - - - - - - - - - - - main - - - - - - - - - - - - - - - -
 \************************************************************************/
 
+#ifndef FUZZ
 int main( int argc, char *argv[] )
 {
 	uchar *ofname = NULL; 				/* Name of outputfile */
@@ -337,7 +747,6 @@ int main( int argc, char *argv[] )
 	uchar in_buf[129];		 				/* buffer to read the files */
 
 	char *errptr;							/* pointer for return value of strtol */
-	int i;									/* index used for loops */
 	int c;									/* value returned by getopt */
 	int pw_spec = 0;						/* flag: was the width of the page given
 												 * as a parameter ? */
@@ -367,7 +776,7 @@ int main( int argc, char *argv[] )
 		prog = strrchr(prog, '\\') + 1;
 	#endif
    /* Get all given parameters and check if they are valid */
-	while ((c = getopt( argc, argv, "c:dfhl:m::o:t::w:W:sB" )) != EOF) {
+	while ((c = getopt( argc, argv, OPTIONS )) != EOF) {
 		switch (c) {
 			case 'c':				/* Parameter specifies number of columns */
 				cn_spec = 1;
@@ -392,6 +801,21 @@ int main( int argc, char *argv[] )
 				fprintf( stderr, "linefeed after every page set on\n" );
 				#endif				
 				break;
+			#ifdef FOLLOW
+			case 'F':				/* Wait for more input at the end of the last file */
+				follow = 1;
+				if ( optarg != NULL ) {
+					idle_ms = strtol( optarg, &errptr, 0 );
+					if ( idle_ms <= 0 || *errptr != '\0' ) {
+						fprintf( stderr, "Invalid parameter for option -F\n" );
+						exit( 1 );
+					}
+				}
+				#ifdef DEBUG
+				fprintf( stderr, "follow mode set on, idle time %d ms\n", idle_ms );
+				#endif				
+				break;
+			#endif
 			case 'l':				/* Number of lines on one page */
 				pg_lines = strtol( optarg, &errptr, 0);
 				if ( pg_lines <= 0 || *errptr != '\0' ) {
@@ -605,20 +1029,7 @@ int main( int argc, char *argv[] )
       } /* end if ofname */
       
 	/*  Allocate memory for the output page */
-	if ( !(cur_page = (uchar**)malloc( pg_lines * sizeof( uchar* ) )) ) {
-		perror( "malloc" );
-		exit(1);
-	} /* end if */
-   for (i = 0; i < pg_lines; i++) {
-   	/* allocate memory for every line. We need one extra byte if word
-		 * wrapping is on, because of a posible overlapping last character */
-      if ( !(cur_page[i] = (uchar*)malloc( (pg_width + word_wrap) * sizeof(uchar)))) {
-         perror( "malloc" );
-         exit(1);
-      } /* end if */
-      spc( cur_page[i], left_spc );
-   } /* end for */
-	pcur_pos = &cur_page[0][left_spc];
+	allocpg();
    /* Set input file to first filename for input or stdin if no input name
     * was specified. */
 	if ( optind >= argc )
@@ -636,6 +1047,11 @@ int main( int argc, char *argv[] )
 	do {
 		optind++;
 		/* second loop which reads every file until eof is reached */
+		#ifdef FOLLOW
+		if ( follow && optind >= argc )
+			followfile( in_file );			/* last file: wait for more input */
+		else
+		#endif
 		while ( fgets( in_buf, sizeof( in_buf ), in_file ) ) {
 			puttooutbuf( in_buf );
 		} /* end while */
@@ -674,3 +1090,134 @@ int main( int argc, char *argv[] )
 	}
    return 0;
 }
+#endif /* !FUZZ */
+
+#ifdef FUZZ
+/************************************************************************\
+ - - - - - - - - - - - - - - - differential fuzzing - - - - - - - - - - - -
+ * Compile with -DFUZZ to get a harness which lays out the same input with
+ * the reference engine and with puttooutbuf()/setnewline() and aborts if
+ * the output differs by a single byte.
+ * The first 9 bytes of an input select the options and the size of the
+ * pieces the text is passed to puttooutbuf() in, like read() returns them
+ * in follow mode; the reference engine gets the text split like fgets()
+ * splits it. The rest of the input is the text.
+ * With -DLIBFUZZER the entry point is left to libFuzzer (-fsanitize=fuzzer),
+ * otherwise main() replays every file given as a parameter (or stdin, which
+ * is what AFL expects) through the harness.
+\************************************************************************/
+static void fuzz_layout( size_t chunk, __const__ uchar *data, size_t size,
+                         char **pout, size_t *plen )
+/* chunk = 0: reference engine, text split like fgets() does
+ * chunk > 0: puttooutbuf() with pieces of chunk bytes */
+{
+	uchar in_buf[129];		 				/* same buffer fgets() uses in main */
+	size_t l;
+
+	if ( (out_file = open_memstream( pout, plen )) == NULL ) {
+		perror( "open_memstream" );
+		exit(1);
+	}
+	cur_col = cur_col_pos = cur_line = 0;
+	allocpg();
+	while ( size > 0 ) {
+		if ( chunk == 0 ) {
+			/* split the text like fgets() does: after a newline character or
+			 * when the buffer is full */
+			for ( l = 0; l < size && l < sizeof( in_buf ) - 1; )
+				if ( data[l++] == '\n' ) break;
+		} else
+			l = size < chunk ? size : chunk;
+		memcpy( in_buf, data, l );
+		in_buf[l] = '\0';
+		if ( chunk == 0 )
+			puttooutbuf_ref( in_buf );
+		else
+			puttooutbuf( in_buf );
+		data+= l;
+		size-= l;
+	} /* end while */
+	printpgrest();
+	fclose( out_file );
+	return;
+}
+
+int LLVMFuzzerTestOneInput( __const__ uchar *data, size_t size )
+{
+	char *out[2];
+	size_t len[2];
+	size_t chunk;
+
+	if ( size < 9 ) return 0;
+	/* keep the page small, so that page and column breaks are frequent */
+	cols = 1 + data[0] % 4;
+	col_width = 1 + data[1] % 24;
+	pg_lines = 1 + data[2] % 12;
+	left_spc = data[3] % 5;
+	mid_spc = data[4] % 4;
+	tab_spc = 1 + data[5] % 8;
+	word_wrap = data[6] & 1;
+	expand_tabs = (data[6] >> 1) & 1;
+	dbllf = (data[6] >> 2) & 1;
+	sendff = (data[6] >> 3) & 1;
+	pg_width = cols * col_width + (cols - 1) * mid_spc + left_spc + data[7] % 4;
+	chunk = 1 + data[8] % 128;
+
+	fuzz_layout( 0, data + 9, size - 9, &out[0], &len[0] );
+	fuzz_layout( chunk, data + 9, size - 9, &out[1], &len[1] );
+	if ( len[0] != len[1] || memcmp( out[0], out[1], len[0] ) ) {
+		fprintf( stderr, "output differs from reference engine "
+			"(-c%d -w%d -l%d -m%d mid %d -t%d B%d t%d d%d f%d W%d chunk %d)\n",
+			cols, col_width, pg_lines, left_spc, mid_spc, tab_spc,
+			word_wrap, expand_tabs, dbllf, sendff, pg_width, (int)chunk );
+		abort();
+	}
+	free( out[0] );
+	free( out[1] );
+	return 0;
+}
+
+#ifndef LIBFUZZER
+/* Read a whole file into a malloc()ed buffer */
+static uchar *fuzz_read( FILE *f, size_t *psize )
+{
+	uchar *buf = NULL;
+	size_t n = 0, l;
+
+	do {
+		if ( (buf = (uchar*)realloc( buf, n + 4096 )) == NULL ) {
+			perror( "realloc" );
+			exit(1);
+		}
+		l = fread( buf + n, 1, 4096, f );
+		n+= l;
+	} while ( l == 4096 );
+	*psize = n;
+	return buf;
+}
+
+int main( int argc, char *argv[] )
+{
+	FILE *in_file;
+	uchar *buf;
+	size_t size;
+	int i;
+
+	prog = (uchar*)argv[0];
+	i = 1;
+	do {
+		if ( i >= argc )
+			in_file = stdin;
+		else if ( (in_file = fopen( argv[i], "rb" )) == NULL ) {
+			perror( "fopen" );
+			exit(1);
+		}
+		buf = fuzz_read( in_file, &size );
+		if ( in_file != stdin ) fclose( in_file );
+		LLVMFuzzerTestOneInput( buf, size );
+		free( buf );
+	} while ( ++i < argc );
+	return 0;
+}
+#endif /* !LIBFUZZER */
+#endif /* FUZZ */